@@ -3,13 +3,43 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <stdint.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "_typeof.h"
-#include "_hashtable.h"
 
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/ndarrayobject.h>
 
+/* Hot/cold placement for the dispatch entry points: GCC and Clang put
+   annotated functions in .text.hot / .text.unlikely, keeping the
+   per-call paths dense in the instruction cache while the fallback and
+   error paths move out of line.  A PGO build of this file (see
+   NUMBA_PGO in setup.py) refines the intra-function block layout on
+   top of this. */
+#if defined(__GNUC__)
+#define NB_ATTR_HOT __attribute__((hot))
+#define NB_ATTR_COLD __attribute__((cold))
+#else
+#define NB_ATTR_HOT
+#define NB_ATTR_COLD
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+/* Old MSVC (Python 2.7 builds) compiles C sources without C99 inline */
+#define inline __inline
+#endif
+
 
 /* Cached typecodes for basic scalar types */
 static int tc_int8;
@@ -51,6 +81,10 @@ typedef struct {
     char *buf;
     size_t n;
     size_t allocated;
+    /* When non-NULL, *buf* points into this bytes object's internal
+       storage and growing goes through _PyBytes_Resize() (see
+       string_writer_init_into_bytes) */
+    PyObject *bytes_owner;
     /* A preallocated buffer, sufficient to fit the fingerprint for most types */
     char static_buf[40];
 } string_writer_t;
@@ -61,27 +95,44 @@ string_writer_init(string_writer_t *w)
     w->buf = w->static_buf;
     w->n = 0;
     w->allocated = sizeof(w->static_buf) / sizeof(unsigned char);
+    w->bytes_owner = NULL;
+}
+
+/* Initialize *w* to write directly into a fresh bytes object with an
+   initial capacity of *hint* bytes, avoiding the final copy when the
+   fingerprint is returned to Python.  Call string_writer_finish_bytes()
+   to trim and steal the result. */
+static int
+string_writer_init_into_bytes(string_writer_t *w, size_t hint)
+{
+    w->bytes_owner = PyBytes_FromStringAndSize(NULL, hint);
+    if (w->bytes_owner == NULL)
+        return -1;
+    w->buf = PyBytes_AS_STRING(w->bytes_owner);
+    w->n = 0;
+    w->allocated = hint;
+    return 0;
 }
 
 static void
 string_writer_clear(string_writer_t *w)
 {
-    if (w->buf != w->static_buf)
+    if (w->bytes_owner != NULL)
+        Py_CLEAR(w->bytes_owner);
+    else if (w->buf != w->static_buf)
         free(w->buf);
 }
 
-static void
-string_writer_move(string_writer_t *dest, const string_writer_t *src)
+/* Trim a bytes-backed writer to its actual length and return the bytes
+   object (a new reference).  The writer must not be used afterwards. */
+static PyObject *
+string_writer_finish_bytes(string_writer_t *w)
 {
-    dest->n = src->n;
-    dest->allocated = src->allocated;
-    if (src->buf == src->static_buf) {
-        dest->buf = dest->static_buf;
-        memcpy(dest->buf, src->buf, src->n);
-    }
-    else {
-        dest->buf = src->buf;
-    }
+    PyObject *res = w->bytes_owner;
+    w->bytes_owner = NULL;
+    if (_PyBytes_Resize(&res, w->n))
+        return NULL;
+    return res;
 }
 
 /* Ensure at least *bytes* can be appended to the string writer's buffer. */
@@ -89,44 +140,82 @@ static int
 string_writer_ensure(string_writer_t *w, size_t bytes)
 {
     size_t newsize;
+    char *old, *newbuf;
     bytes += w->n;
-    if (bytes <= w->allocated)
+    /* The vast majority of writes fit in the current buffer */
+    if (NPY_LIKELY(bytes <= w->allocated))
         return 0;
-    newsize = (w->allocated << 2) + 1;
+    /* Grow by 1.5x: small fingerprints stay close to their actual size
+       (the old 4x-plus-one factor turned a 41-byte need into a 161-byte
+       block), and a freed block can be reused by a later, larger
+       request.  Round up to a 16-byte granularity to match common
+       allocator bucket sizes. */
+    newsize = w->allocated + (w->allocated >> 1);
     if (newsize < bytes)
         newsize = bytes;
-    if (w->buf == w->static_buf)
-        w->buf = malloc(newsize);
-    else
-        w->buf = realloc(w->buf, newsize);
-    if (w->buf) {
+    if (newsize < 64)
+        newsize = 64;
+    newsize = (newsize + 15) & ~(size_t) 15;
+    if (w->bytes_owner != NULL) {
+        /* Bytes-backed writer: grow the bytes object in place */
+        if (_PyBytes_Resize(&w->bytes_owner, newsize)) {
+            /* The owner has been deallocated and cleared; reset the
+               buffer so that string_writer_clear() stays a no-op. */
+            w->buf = w->static_buf;
+            return -1;
+        }
+        w->buf = PyBytes_AS_STRING(w->bytes_owner);
         w->allocated = newsize;
         return 0;
     }
-    else {
+    old = (w->buf == w->static_buf) ? NULL : w->buf;
+    newbuf = old ? realloc(old, newsize) : malloc(newsize);
+    if (NPY_UNLIKELY(newbuf == NULL)) {
+        /* Keep the writer's current buffer intact so the caller can
+           still string_writer_clear() it. */
         PyErr_NoMemory();
         return -1;
     }
+    if (old == NULL) {
+        /* First grow out of the static buffer: carry over what was
+           already written. */
+        memcpy(newbuf, w->static_buf, w->n);
+    }
+    w->buf = newbuf;
+    w->allocated = newsize;
+    return 0;
 }
 
 static int
 string_writer_put_char(string_writer_t *w, unsigned char c)
 {
-    if (string_writer_ensure(w, 1))
+    if (NPY_UNLIKELY(string_writer_ensure(w, 1)))
         return -1;
     w->buf[w->n++] = c;
     return 0;
 }
 
+/* Integers are serialized little-endian; on big-endian hosts we byteswap
+   first so a small fixed-size memcpy (which compilers lower to a single
+   unaligned store) replaces the old byte-by-byte shift-and-store
+   sequences. */
+
+static inline uint32_t
+to_le32(uint32_t v)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
 static int
 string_writer_put_int32(string_writer_t *w, unsigned int v)
 {
-    if (string_writer_ensure(w, 4))
+    uint32_t le = to_le32((uint32_t) v);
+    if (NPY_UNLIKELY(string_writer_ensure(w, 4)))
         return -1;
-    w->buf[w->n] = v & 0xff;
-    w->buf[w->n + 1] = (v >> 8) & 0xff;
-    w->buf[w->n + 2] = (v >> 16) & 0xff;
-    w->buf[w->n + 3] = (v >> 24) & 0xff;
+    memcpy(w->buf + w->n, &le, 4);
     w->n += 4;
     return 0;
 }
@@ -134,20 +223,28 @@ string_writer_put_int32(string_writer_t *w, unsigned int v)
 static int
 string_writer_put_intp(string_writer_t *w, npy_intp v)
 {
-    const int N = sizeof(npy_intp);
-    if (string_writer_ensure(w, N))
+    npy_uintp le = (npy_uintp) v;
+    if (NPY_UNLIKELY(string_writer_ensure(w, sizeof(le))))
         return -1;
-    w->buf[w->n] = v & 0xff;
-    w->buf[w->n + 1] = (v >> 8) & 0xff;
-    w->buf[w->n + 2] = (v >> 16) & 0xff;
-    w->buf[w->n + 3] = (v >> 24) & 0xff;
-    if (N > 4) {
-        w->buf[w->n + 4] = (v >> 32) & 0xff;
-        w->buf[w->n + 5] = (v >> 40) & 0xff;
-        w->buf[w->n + 6] = (v >> 48) & 0xff;
-        w->buf[w->n + 7] = (v >> 56) & 0xff;
-    }
-    w->n += N;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#if NPY_SIZEOF_INTP == 8
+    le = __builtin_bswap64(le);
+#else
+    le = __builtin_bswap32(le);
+#endif
+#endif
+    memcpy(w->buf + w->n, &le, sizeof(le));
+    w->n += sizeof(le);
+    return 0;
+}
+
+static int
+string_writer_put_bytes(string_writer_t *w, const void *src, size_t n)
+{
+    if (NPY_UNLIKELY(string_writer_ensure(w, n)))
+        return -1;
+    memcpy(w->buf + w->n, src, n);
+    w->n += n;
     return 0;
 }
 
@@ -158,12 +255,7 @@ string_writer_put_string(string_writer_t *w, const char *s)
         return string_writer_put_char(w, 0);
     }
     else {
-        size_t N = strlen(s) + 1;
-        if (string_writer_ensure(w, N))
-            return -1;
-        memcpy(w->buf + w->n, s, N);
-        w->n += N;
-        return 0;
+        return string_writer_put_bytes(w, s, strlen(s) + 1);
     }
 }
 
@@ -193,8 +285,29 @@ enum opcode {
         if (func(w, arg)) return -1; \
     } while (0)
 
+/* Compute the layout index (0 = any, 1 = C, 2 = F) from the array flags
+   without unpredictable branches.  C-contiguity has priority over
+   F-contiguity, matching numba.numpy_support.map_layout (0-d and
+   single-element arrays carry both flags).  Only *contiguous-ness* is
+   considered, not alignment, byte order or write permissions. */
+static inline int
+flags_to_layout(int flags)
+{
+    int cc = (flags & NPY_ARRAY_C_CONTIGUOUS) != 0;
+    int fc = (flags & NPY_ARRAY_F_CONTIGUOUS) != 0;
+    return cc | ((fc & ~cc) << 1);
+}
 
-static int
+/* The array/buffer fingerprints encode the layout index (0/1/2 = A/C/F,
+   as above) and writability in a single byte: shorter fingerprints hash
+   and compare faster, and pack more keys per arena chunk.  Fingerprints
+   only ever live in the in-process cache, so the encoding can change
+   between versions without invalidating anything. */
+#define ARRAY_META_BYTE(layout, writable) \
+    ((char) (((layout) << 1) | (writable)))
+
+
+static NB_ATTR_COLD int
 fingerprint_unrecognized(PyObject *val)
 {
     PyErr_SetString(PyExc_NotImplementedError,
@@ -202,6 +315,31 @@ fingerprint_unrecognized(PyObject *val)
     return -1;
 }
 
+/* Fast dispatch for the basic Numpy scalar types: map the scalar's exact
+   Python type object to its dtype typenum, avoiding the
+   PyArray_DescrFromScalar() round-trip on every dispatch.  Populated in
+   typeof_init(); subclasses and non-basic scalars (structured, datetime,
+   unicode...) miss and take the descr-based slow path. */
+#define N_FAST_SCALARS 12
+static struct {
+    PyTypeObject *scalar_type;
+    char typenum;
+} fast_scalars[N_FAST_SCALARS];
+
+static int
+fast_scalar_typenum(PyObject *val)
+{
+    PyTypeObject *tp = Py_TYPE(val);
+    int i;
+    /* A linear scan of 12 pointer compares is cheaper than a single
+       C API call */
+    for (i = 0; i < N_FAST_SCALARS; i++) {
+        if (fast_scalars[i].scalar_type == tp)
+            return fast_scalars[i].typenum;
+    }
+    return -1;
+}
+
 static int
 compute_dtype_fingerprint(string_writer_t *w, PyArray_Descr *descr)
 {
@@ -238,7 +376,104 @@ compute_dtype_fingerprint(string_writer_t *w, PyArray_Descr *descr)
     return fingerprint_unrecognized((PyObject *) descr);
 }
 
+static NB_ATTR_HOT int
+compute_fingerprint(string_writer_t *w, PyObject *val);
+
+static int
+fingerprint_ndarray(string_writer_t *w, PyArrayObject *ary)
+{
+    uint32_t ndim = to_le32((uint32_t) PyArray_NDIM(ary));
+    int flags = PyArray_FLAGS(ary);
+    char header[6];
+
+    /* Emit the whole array header with a single bounds check */
+    header[0] = OP_NP_ARRAY;
+    memcpy(header + 1, &ndim, 4);
+    header[5] = ARRAY_META_BYTE(flags_to_layout(flags),
+                                (flags & NPY_ARRAY_WRITEABLE) != 0);
+    if (string_writer_put_bytes(w, header, sizeof(header)))
+        return -1;
+    return compute_dtype_fingerprint(w, PyArray_DESCR(ary));
+}
+
+/* Per-element dispatch for tuple fingerprints.  Walking the full check
+   chain of compute_fingerprint() costs ~8 type tests per element; the
+   exact type objects of the common element types are matched here with
+   a short pointer scan instead, hottest types first.  The table is
+   populated in typeof_init() (some type objects, e.g. PyArray_Type,
+   are not link-time constants); anything not in it falls back on
+   compute_fingerprint(). */
+typedef int (*fp_emitter_t)(string_writer_t *w, PyObject *val);
+
+#define FP_DISPATCH_MAX 8
+static struct {
+    PyTypeObject *type;
+    fp_emitter_t emit;
+} fp_dispatch[FP_DISPATCH_MAX];
+static int fp_dispatch_n = 0;
+
 static int
+fp_emit_int(string_writer_t *w, PyObject *val)
+{
+    return string_writer_put_char(w, OP_INT);
+}
+
+static int
+fp_emit_float(string_writer_t *w, PyObject *val)
+{
+    return string_writer_put_char(w, OP_FLOAT);
+}
+
+static int
+fp_emit_complex(string_writer_t *w, PyObject *val)
+{
+    return string_writer_put_char(w, OP_COMPLEX);
+}
+
+static int
+fp_emit_bool(string_writer_t *w, PyObject *val)
+{
+    return string_writer_put_char(w, OP_BOOL);
+}
+
+static int
+fp_emit_none(string_writer_t *w, PyObject *val)
+{
+    return string_writer_put_char(w, OP_NONE);
+}
+
+static int
+fp_emit_ndarray(string_writer_t *w, PyObject *val)
+{
+    return fingerprint_ndarray(w, (PyArrayObject *) val);
+}
+
+static int
+fingerprint_tuple(string_writer_t *w, PyObject *val)
+{
+    Py_ssize_t i, n = PyTuple_GET_SIZE(val);
+
+    TRY(string_writer_put_char, w, OP_START_TUPLE);
+    for (i = 0; i < n; i++) {
+        PyObject *elt = PyTuple_GET_ITEM(val, i);
+        PyTypeObject *tp = Py_TYPE(elt);
+        int j;
+        for (j = 0; j < fp_dispatch_n; j++) {
+            if (fp_dispatch[j].type == tp) {
+                if (fp_dispatch[j].emit(w, elt))
+                    return -1;
+                goto next;
+            }
+        }
+        /* Not one of the common element types: full dispatch */
+        TRY(compute_fingerprint, w, elt);
+    next:
+        ;
+    }
+    return string_writer_put_char(w, OP_END_TUPLE);
+}
+
+static NB_ATTR_HOT int
 compute_fingerprint(string_writer_t *w, PyObject *val)
 {
     /*
@@ -256,15 +491,8 @@ compute_fingerprint(string_writer_t *w, PyObject *val)
         return string_writer_put_char(w, OP_FLOAT);
     if (PyComplex_CheckExact(val))
         return string_writer_put_char(w, OP_COMPLEX);
-    if (PyTuple_Check(val)) {
-        Py_ssize_t i, n;
-        n = PyTuple_GET_SIZE(val);
-        TRY(string_writer_put_char, w, OP_START_TUPLE);
-        for (i = 0; i < n; i++)
-            TRY(compute_fingerprint, w, PyTuple_GET_ITEM(val, i));
-        TRY(string_writer_put_char, w, OP_END_TUPLE);
-        return 0;
-    }
+    if (PyTuple_Check(val))
+        return fingerprint_tuple(w, val);
     if (PyBytes_Check(val))
         return string_writer_put_char(w, OP_BYTES);
     if (PyByteArray_Check(val))
@@ -279,9 +507,18 @@ compute_fingerprint(string_writer_t *w, PyObject *val)
         return 0;
     }
     if (PyArray_IsScalar(val, Generic)) {
+        PyArray_Descr *descr;
+        int typenum = fast_scalar_typenum(val);
+        if (typenum >= 0) {
+            /* Basic scalar type: emit the same bytes as
+               compute_dtype_fingerprint() would, without materializing
+               the descr. */
+            TRY(string_writer_put_char, w, OP_NP_SCALAR);
+            return string_writer_put_char(w, (char) typenum);
+        }
         /* Note: PyArray_DescrFromScalar() may be a bit slow on
            non-trivial types. */
-        PyArray_Descr *descr = PyArray_DescrFromScalar(val);
+        descr = PyArray_DescrFromScalar(val);
         if (descr == NULL)
             return -1;
         TRY(string_writer_put_char, w, OP_NP_SCALAR);
@@ -289,24 +526,8 @@ compute_fingerprint(string_writer_t *w, PyObject *val)
         Py_DECREF(descr);
         return 0;
     }
-    if (PyArray_Check(val)) {
-        PyArrayObject *ary = (PyArrayObject *) val;
-        int ndim = PyArray_NDIM(ary);
-
-        TRY(string_writer_put_char, w, OP_NP_ARRAY);
-        TRY(string_writer_put_int32, w, ndim);
-        if (PyArray_IS_C_CONTIGUOUS(ary))
-            TRY(string_writer_put_char, w, 'C');
-        else if (PyArray_IS_F_CONTIGUOUS(ary))
-            TRY(string_writer_put_char, w, 'F');
-        else
-            TRY(string_writer_put_char, w, 'A');
-        if (PyArray_ISWRITEABLE(ary))
-            TRY(string_writer_put_char, w, 'W');
-        else
-            TRY(string_writer_put_char, w, 'R');
-        return compute_dtype_fingerprint(w, PyArray_DESCR(ary));
-    }
+    if (PyArray_Check(val))
+        return fingerprint_ndarray(w, (PyArrayObject *) val);
     if (PyList_Check(val)) {
         Py_ssize_t n = PyList_GET_SIZE(val);
         if (n == 0) {
@@ -338,9 +559,9 @@ compute_fingerprint(string_writer_t *w, PyObject *val)
     if (PyObject_CheckBuffer(val)) {
         Py_buffer buf;
         int flags = PyBUF_ND | PyBUF_STRIDES | PyBUF_FORMAT;
-        char contig;
-        int ndim;
-        char readonly;
+        uint32_t ndim;
+        int layout;
+        char header[6];
 
         /* Attempt to get a writable buffer, then fallback on read-only */
         if (PyObject_GetBuffer(val, &buf, flags | PyBUF_WRITABLE)) {
@@ -348,18 +569,18 @@ compute_fingerprint(string_writer_t *w, PyObject *val)
             if (PyObject_GetBuffer(val, &buf, flags))
                 goto _unrecognized;
         }
+        /* As for arrays, emit the fixed-size header in one go */
+        header[0] = OP_BUFFER;
+        ndim = to_le32((uint32_t) buf.ndim);
+        memcpy(header + 1, &ndim, 4);
         if (PyBuffer_IsContiguous(&buf, 'C'))
-            contig = 'C';
+            layout = 1;
         else if (PyBuffer_IsContiguous(&buf, 'F'))
-            contig = 'F';
+            layout = 2;
         else
-            contig = 'A';
-        ndim = buf.ndim;
-        readonly = buf.readonly ? 'R' : 'W';
-        if (string_writer_put_char(w, OP_BUFFER) ||
-            string_writer_put_int32(w, ndim) ||
-            string_writer_put_char(w, contig) ||
-            string_writer_put_char(w, readonly) ||
+            layout = 0;
+        header[5] = ARRAY_META_BYTE(layout, !buf.readonly);
+        if (string_writer_put_bytes(w, header, sizeof(header)) ||
             string_writer_put_string(w, buf.format) ||
             /* We serialize the object's Python type as well, to
                distinguish between types which have Numba specializations
@@ -385,21 +606,19 @@ _unrecognized:
 PyObject *
 typeof_compute_fingerprint(PyObject *val)
 {
-    PyObject *res;
     string_writer_t w;
 
-    string_writer_init(&w);
-
-    if (compute_fingerprint(&w, val))
-        goto error;
-    res = PyBytes_FromStringAndSize(w.buf, w.n);
-
-    string_writer_clear(&w);
-    return res;
+    /* Write straight into the bytes object that will be returned,
+       rather than into a scratch buffer copied at the end.  64 bytes
+       covers most fingerprints; longer ones grow in place. */
+    if (string_writer_init_into_bytes(&w, 64))
+        return NULL;
 
-error:
-    string_writer_clear(&w);
-    return NULL;
+    if (compute_fingerprint(&w, val)) {
+        string_writer_clear(&w);
+        return NULL;
+    }
+    return string_writer_finish_bytes(&w);
 }
 
 /*
@@ -445,7 +664,7 @@ _typecode_from_type_object(PyObject *tyobj) {
    However, we don't need to refer to it again, we just need to make sure that
    it is never deleted.
 */
-static int
+static NB_ATTR_COLD int
 _typecode_fallback(PyObject *dispatcher, PyObject *val,
                    int retain_reference) {
     PyObject *numba_type;
@@ -488,52 +707,411 @@ int typecode_fallback_keep_ref(PyObject *dispatcher, PyObject *val) {
 }
 
 
-/* A cache mapping fingerprints (string_writer_t *) to typecodes (int). */
-static _Numba_hashtable_t *fingerprint_hashtable = NULL;
+/*
+ * A cache mapping fingerprints to typecodes (int), implemented as an
+ * open-addressed robin-hood hash table specialized for fingerprint byte
+ * strings (see fp_cache_t below).
+ */
+
+/* A view on fingerprint bytes, used as the cache key type.  Stored keys
+   point at bytes packed in the arena right after the view itself. */
+typedef struct {
+    const char *buf;
+    size_t n;
+} fp_view_t;
+
+/* Arena allocator for the fingerprint cache keys.  Keys are inserted once
+   and live until process shutdown (the cache is never pruned, see the
+   comment above _typecode_fallback()), so they are packed into
+   bump-allocated chunks instead of being individually malloc'ed.  This
+   removes two mallocs per new signature and keeps keys that are probed
+   together contiguous in memory. */
+typedef struct fp_arena_chunk {
+    struct fp_arena_chunk *prev;
+    char *next;
+    char *end;
+} fp_arena_chunk_t;
+
+#define FP_ARENA_CHUNK_SIZE (32 * 1024)
+
+static fp_arena_chunk_t *fp_arena = NULL;
+
+static void *
+fp_arena_alloc(size_t size)
+{
+    fp_arena_chunk_t *chunk = fp_arena;
+    void *p;
+
+    /* Keep records naturally aligned for the embedded view struct */
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (chunk == NULL || (size_t) (chunk->end - chunk->next) < size) {
+        size_t chunk_size = FP_ARENA_CHUNK_SIZE;
+        if (chunk_size < sizeof(fp_arena_chunk_t) + size)
+            chunk_size = sizeof(fp_arena_chunk_t) + size;
+        chunk = malloc(chunk_size);
+        if (chunk == NULL)
+            return NULL;
+        chunk->prev = fp_arena;
+        chunk->next = (char *) (chunk + 1);
+        chunk->end = (char *) chunk + chunk_size;
+        fp_arena = chunk;
+    }
+    p = chunk->next;
+    chunk->next += size;
+    return p;
+}
+
+/* Copy a just-computed fingerprint into the arena and return a view on
+   it, suitable for insertion into the cache.  Returns NULL on memory
+   exhaustion. */
+static fp_view_t *
+fp_arena_intern(const string_writer_t *w)
+{
+    fp_view_t *key = (fp_view_t *) fp_arena_alloc(sizeof(fp_view_t) + w->n);
+    if (key == NULL)
+        return NULL;
+    key->buf = (char *) (key + 1);
+    key->n = w->n;
+    memcpy((char *) (key + 1), w->buf, w->n);
+    return key;
+}
 
 static Py_uhash_t
-hash_writer(const void *key)
+fp_hash_bytes(const char *buf, size_t n)
 {
-    string_writer_t *writer = (string_writer_t *) key;
     Py_uhash_t x = 0;
 
-    /* The old FNV algorithm used by Python 2 */
-    if (writer->n > 0) {
-        unsigned char *p = (unsigned char *) writer->buf;
-        Py_ssize_t len = writer->n;
+    if (n > 0) {
+        const unsigned char *p = (const unsigned char *) buf;
+        size_t len = n;
+#if defined(__SSE4_2__)
+        /* Hardware CRC32C (SSE4.2), 8 bytes per round instead of the
+           1 byte per multiply of the FNV fallback below.  Seed with the
+           length so that the hash stays sensitive to it. */
+        uint64_t h = (uint64_t) n;
+        while (len >= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, p, 8);
+            h = _mm_crc32_u64(h, chunk);
+            p += 8;
+            len -= 8;
+        }
+        if (len >= 4) {
+            uint32_t chunk;
+            memcpy(&chunk, p, 4);
+            h = _mm_crc32_u32((uint32_t) h, chunk);
+            p += 4;
+            len -= 4;
+        }
+        if (len >= 2) {
+            uint16_t chunk;
+            memcpy(&chunk, p, 2);
+            h = _mm_crc32_u16((uint32_t) h, chunk);
+            p += 2;
+            len -= 2;
+        }
+        if (len)
+            h = _mm_crc32_u8((uint32_t) h, *p);
+        x = (Py_uhash_t) h;
+#elif defined(__ARM_FEATURE_CRC32)
+        /* Same scheme with the ARMv8 CRC32C (ACLE) intrinsics */
+        uint32_t h = (uint32_t) n;
+        while (len >= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, p, 8);
+            h = __crc32cd(h, chunk);
+            p += 8;
+            len -= 8;
+        }
+        if (len >= 4) {
+            uint32_t chunk;
+            memcpy(&chunk, p, 4);
+            h = __crc32cw(h, chunk);
+            p += 4;
+            len -= 4;
+        }
+        if (len >= 2) {
+            uint16_t chunk;
+            memcpy(&chunk, p, 2);
+            h = __crc32ch(h, chunk);
+            p += 2;
+            len -= 2;
+        }
+        if (len)
+            h = __crc32cb(h, *p);
+        x = (Py_uhash_t) h;
+#else
+        /* The old FNV algorithm used by Python 2 */
+        Py_ssize_t slen = (Py_ssize_t) len;
         x ^= *p << 7;
-        while (--len >= 0)
+        while (--slen >= 0)
             x = (1000003*x) ^ *p++;
-        x ^= writer->n;
-        if (x == (Py_uhash_t) -1)
-            x = -2;
+        x ^= n;
+#endif
     }
     return x;
 }
 
+/* Compare *n* bytes for equality.  Fingerprints are typically a few dozen
+   bytes, for which the call and dispatch overhead of libc's memcmp
+   dominates; compare with inline vector (or word) loads instead.  Tails
+   are handled with overlapped loads so we never read past either buffer. */
+static inline int
+bytes_equal(const unsigned char *a, const unsigned char *b, size_t n)
+{
+#if defined(__SSE2__)
+#if defined(__AVX2__)
+    while (n >= 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i *) a);
+        __m256i vb = _mm256_loadu_si256((const __m256i *) b);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)) != -1)
+            return 0;
+        a += 32;
+        b += 32;
+        n -= 32;
+    }
+#endif
+    if (n >= 16) {
+        __m128i va, vb;
+        while (n > 16) {
+            va = _mm_loadu_si128((const __m128i *) a);
+            vb = _mm_loadu_si128((const __m128i *) b);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff)
+                return 0;
+            a += 16;
+            b += 16;
+            n -= 16;
+        }
+        va = _mm_loadu_si128((const __m128i *) (a + n - 16));
+        vb = _mm_loadu_si128((const __m128i *) (b + n - 16));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xffff;
+    }
+    if (n >= 8) {
+        uint64_t x0, x1, y0, y1;
+        memcpy(&x0, a, 8);
+        memcpy(&y0, b, 8);
+        memcpy(&x1, a + n - 8, 8);
+        memcpy(&y1, b + n - 8, 8);
+        return ((x0 ^ y0) | (x1 ^ y1)) == 0;
+    }
+    if (n >= 4) {
+        uint32_t x0, x1, y0, y1;
+        memcpy(&x0, a, 4);
+        memcpy(&y0, b, 4);
+        memcpy(&x1, a + n - 4, 4);
+        memcpy(&y1, b + n - 4, 4);
+        return ((x0 ^ y0) | (x1 ^ y1)) == 0;
+    }
+    while (n--) {
+        if (*a++ != *b++)
+            return 0;
+    }
+    return 1;
+#else
+    return memcmp(a, b, n) == 0;
+#endif
+}
+
+/* The fingerprint cache proper.  Entries are stored inline in a
+   power-of-two sized, open-addressed table with robin-hood displacement
+   and a maximum load factor of 0.5: a probe is a linear scan of
+   contiguous slots comparing the full hash first (a cheap early-out),
+   with no per-entry allocation or chain pointer to follow.  This
+   replaces the chaining _Numba_hashtable previously used here. */
+typedef struct {
+    Py_uhash_t hash;
+    fp_view_t *key;        /* Arena-interned; NULL marks an empty slot */
+    int typecode;
+} fp_cache_entry_t;
+
+typedef struct {
+    fp_cache_entry_t *entries;
+    size_t mask;           /* Table size - 1 (size is a power of two) */
+    size_t used;
+} fp_cache_t;
+
+/* The table and the key arena are preallocated in typeof_init(), before
+   any dispatch can reach them: lookup and insertion assume the table
+   exists, which keeps a lazy-creation branch (and the associated
+   first-call initialization race) out of the per-call path.  256 slots
+   hold 128 signatures at the 0.5 load factor, enough for typical
+   sessions without a resize. */
+#define FP_CACHE_INITIAL_SIZE 256
+
+static fp_cache_t fp_cache = { NULL, 0, 0 };
+
+/* Distance between the slot an entry currently sits in and the slot its
+   hash maps to. */
+#define FP_CACHE_DISTANCE(cache, slot, entry_hash) \
+    (((slot) - (size_t) (entry_hash)) & (cache)->mask)
+
+/* Look up a fingerprint.  Returns 1 and fills *typecode on a hit,
+   0 on a miss. */
 static int
-compare_writer(const void *key, const _Numba_hashtable_entry_t *entry)
+fp_cache_lookup(const char *buf, size_t n, Py_uhash_t hash, int *typecode)
 {
-    string_writer_t *v = (string_writer_t *) key;
-    string_writer_t *w = (string_writer_t *) entry->key;
-    if (v->n != w->n)
-        return 0;
-    return memcmp(v->buf, w->buf, v->n) == 0;
+    fp_cache_t *cache = &fp_cache;
+    size_t i, dist;
+
+    i = (size_t) hash & cache->mask;
+    dist = 0;
+    for (;;) {
+        fp_cache_entry_t *e = &cache->entries[i];
+        if (e->key == NULL)
+            return 0;
+        if (e->hash == hash && e->key->n == n) {
+#if defined(__GNUC__)
+            /* For long fingerprints, pull in the stored key's second
+               cache line while the first one is being compared. */
+            if (n > 64)
+                __builtin_prefetch(e->key->buf + 64, 0, 0);
+#endif
+            if (bytes_equal((const unsigned char *) e->key->buf,
+                            (const unsigned char *) buf, n)) {
+                *typecode = e->typecode;
+                return 1;
+            }
+        }
+        /* Robin-hood invariant: entries on a probe sequence are ordered
+           by their distance to home, so once we meet an entry closer to
+           its home slot than we are to ours, the key cannot be present
+           further along. */
+        if (FP_CACHE_DISTANCE(cache, i, e->hash) < dist)
+            return 0;
+        i = (i + 1) & cache->mask;
+        dist++;
+    }
 }
 
-/* Try to compute *val*'s typecode using its fingerprint and the
- * fingerprint->typecode cache.
- */
+/* Insert an entry into a table known to have a free slot, displacing
+   richer entries along the way (robin-hood hashing). */
+static void
+fp_cache_insert(fp_cache_t *cache, Py_uhash_t hash, fp_view_t *key,
+                int typecode)
+{
+    fp_cache_entry_t incoming, tmp;
+    size_t i, dist;
+
+    incoming.hash = hash;
+    incoming.key = key;
+    incoming.typecode = typecode;
+    i = (size_t) hash & cache->mask;
+    dist = 0;
+    for (;;) {
+        fp_cache_entry_t *e = &cache->entries[i];
+        size_t e_dist;
+        if (e->key == NULL) {
+            *e = incoming;
+            return;
+        }
+        e_dist = FP_CACHE_DISTANCE(cache, i, e->hash);
+        if (e_dist < dist) {
+            /* The resident entry is richer: swap and keep inserting the
+               displaced one. */
+            tmp = *e;
+            *e = incoming;
+            incoming = tmp;
+            dist = e_dist;
+        }
+        i = (i + 1) & cache->mask;
+        dist++;
+    }
+}
+
+/* (Re)allocate the table to hold *size* slots (a power of two) and
+   reinsert any existing entries.  Returns 0 on success, -1 on memory
+   exhaustion (the previous table is then left untouched). */
 static int
-typecode_using_fingerprint(PyObject *dispatcher, PyObject *val)
+fp_cache_resize(size_t size)
+{
+    fp_cache_t *cache = &fp_cache;
+    fp_cache_entry_t *old_entries = cache->entries;
+    size_t old_size = old_entries ? cache->mask + 1 : 0;
+    size_t i;
+
+    cache->entries = (fp_cache_entry_t *) calloc(size, sizeof(fp_cache_entry_t));
+    if (cache->entries == NULL) {
+        cache->entries = old_entries;
+        return -1;
+    }
+    cache->mask = size - 1;
+    for (i = 0; i < old_size; i++) {
+        fp_cache_entry_t *e = &old_entries[i];
+        if (e->key != NULL)
+            fp_cache_insert(cache, e->hash, e->key, e->typecode);
+    }
+    free(old_entries);
+    return 0;
+}
+
+/* Add a new fingerprint -> typecode mapping.  Returns 0 on success,
+   -1 on memory exhaustion. */
+static int
+fp_cache_set(Py_uhash_t hash, fp_view_t *key, int typecode)
 {
+    fp_cache_t *cache = &fp_cache;
+
+    if ((cache->used + 1) * 2 > cache->mask + 1) {
+        /* Keep the load factor at or below 0.5 */
+        if (fp_cache_resize((cache->mask + 1) * 2))
+            return -1;
+    }
+    fp_cache_insert(cache, hash, key, typecode);
+    cache->used++;
+    return 0;
+}
+
+/* Per-thread scratch writer for fingerprint construction.  The writer
+   (and any heap buffer it grew) persists across calls, so the amortized
+   allocation cost of the fingerprint path is one malloc per thread:
+   cache keys are copied into the arena on insertion and the scratch is
+   reused immediately.  The buffer is deliberately retained for the
+   lifetime of the thread, like the arena is for the process. */
+#if defined(_MSC_VER)
+#define FP_THREAD_LOCAL __declspec(thread)
+#else
+#define FP_THREAD_LOCAL __thread
+#endif
+
+static FP_THREAD_LOCAL string_writer_t tls_fp_writer;
+static FP_THREAD_LOCAL int tls_fp_writer_inited = 0;
+static FP_THREAD_LOCAL int tls_fp_writer_busy = 0;
+
+/* One-entry memo of the last resolved fingerprint.  A hot dispatcher is
+   nearly always called with arguments of the same shape, so the same
+   fingerprint is produced back-to-back millions of times; matching it
+   here skips both the hash and the table probe.  Fingerprints longer
+   than the memo buffer simply do not participate.  A fingerprint fully
+   determines its typecode, so the memo can never go stale. */
+#define FP_MEMO_SIZE 64
+
+typedef struct {
+    uint32_t n;            /* 0 while empty */
     int typecode;
-    string_writer_t w;
+    char buf[FP_MEMO_SIZE];
+} fp_memo_t;
 
-    string_writer_init(&w);
+static FP_THREAD_LOCAL fp_memo_t tls_fp_memo;
 
-    if (compute_fingerprint(&w, val)) {
-        string_writer_clear(&w);
+static inline void
+fp_memo_update(fp_memo_t *memo, const string_writer_t *w, int typecode)
+{
+    if (w->n <= FP_MEMO_SIZE) {
+        memcpy(memo->buf, w->buf, w->n);
+        memo->n = (uint32_t) w->n;
+        memo->typecode = typecode;
+    }
+}
+
+static NB_ATTR_HOT int
+typecode_using_fingerprint_writer(PyObject *dispatcher, PyObject *val,
+                                  string_writer_t *w)
+{
+    int typecode;
+    Py_uhash_t hash;
+    fp_memo_t *memo = &tls_fp_memo;
+
+    if (compute_fingerprint(w, val)) {
         if (PyErr_ExceptionMatches(PyExc_NotImplementedError)) {
             /* Can't compute a type fingerprint for the given value,
                fall back on typeof() without caching. */
@@ -542,9 +1120,16 @@ typecode_using_fingerprint(PyObject *dispatcher, PyObject *val)
         }
         return -1;
     }
-    if (_Numba_HASHTABLE_GET(fingerprint_hashtable, &w, typecode) > 0) {
+    if ((size_t) memo->n == w->n &&
+        bytes_equal((const unsigned char *) memo->buf,
+                    (const unsigned char *) w->buf, w->n)) {
+        /* Same shape as the previous call */
+        return memo->typecode;
+    }
+    hash = fp_hash_bytes(w->buf, w->n);
+    if (fp_cache_lookup(w->buf, w->n, hash, &typecode)) {
         /* Cache hit */
-        string_writer_clear(&w);
+        fp_memo_update(memo, w, typecode);
         return typecode;
     }
 
@@ -554,21 +1139,51 @@ typecode_using_fingerprint(PyObject *dispatcher, PyObject *val)
      */
     typecode = typecode_fallback_keep_ref(dispatcher, val);
     if (typecode >= 0) {
-        string_writer_t *key = (string_writer_t *) malloc(sizeof(string_writer_t));
+        fp_view_t *key = fp_arena_intern(w);
         if (key == NULL) {
-            string_writer_clear(&w);
             PyErr_NoMemory();
             return -1;
         }
-        /* Ownership of the string writer's buffer will be transferred
-         * to the hash table.
-         */
-        string_writer_move(key, &w);
-        if (_Numba_HASHTABLE_SET(fingerprint_hashtable, key, typecode)) {
-            string_writer_clear(&w);
+        if (fp_cache_set(hash, key, typecode)) {
             PyErr_NoMemory();
             return -1;
         }
+        fp_memo_update(memo, w, typecode);
+    }
+    return typecode;
+}
+
+/* Try to compute *val*'s typecode using its fingerprint and the
+ * fingerprint->typecode cache.
+ */
+static NB_ATTR_HOT int
+typecode_using_fingerprint(PyObject *dispatcher, PyObject *val)
+{
+    int typecode;
+    string_writer_t stack_writer;
+    string_writer_t *w;
+
+    if (NPY_LIKELY(!tls_fp_writer_busy)) {
+        w = &tls_fp_writer;
+        if (!tls_fp_writer_inited) {
+            string_writer_init(w);
+            tls_fp_writer_inited = 1;
+        }
+        /* Truncate: the (possibly grown) buffer stays warm in cache */
+        w->n = 0;
+        tls_fp_writer_busy = 1;
+        typecode = typecode_using_fingerprint_writer(dispatcher, val, w);
+        tls_fp_writer_busy = 0;
+    }
+    else {
+        /* Fingerprinting can call back into Python (e.g. the buffer
+           protocol or an OmittedArg default), which may re-enter the
+           dispatcher on this thread while the scratch writer is in use;
+           fall back on a stack writer for the nested call. */
+        w = &stack_writer;
+        string_writer_init(w);
+        typecode = typecode_using_fingerprint_writer(dispatcher, val, w);
+        string_writer_clear(w);
     }
     return typecode;
 }
@@ -581,54 +1196,27 @@ typecode_using_fingerprint(PyObject *dispatcher, PyObject *val)
 #define N_DTYPES 12
 #define N_NDIM 5    /* Fast path for up to 5D array */
 #define N_LAYOUT 3
-static int cached_arycode[N_NDIM][N_LAYOUT][N_DTYPES];
+
+/* The table is stored flat with the dtype index innermost, so the
+   entries for consecutive dtype misses of the same (ndim, layout)
+   share a cache line; indexing is made explicit through ARYCODE_IDX.
+   *ndim* here is the zero-based index, i.e. PyArray_NDIM() - 1. */
+#define ARYCODE_IDX(ndim, layout, dtype) \
+    ((((ndim) * N_LAYOUT) + (layout)) * N_DTYPES + (dtype))
+
+static int cached_arycode[N_NDIM * N_LAYOUT * N_DTYPES];
 
 /* Convert a Numpy dtype number to an internal index into cached_arycode.
-   The returned value must also be a valid index into BASIC_TYPECODES. */
+   The returned value must also be a valid index into BASIC_TYPECODES.
+   Dtype numbers not included in the global lookup table map to -1.
+   The LUT is populated in typeof_init(); a guarded load replaces the
+   old 12-way switch on this per-array-typeof path. */
+static signed char dtype_num_lut[NPY_NTYPES];
+
 static int dtype_num_to_typecode(int type_num) {
-    int dtype;
-    switch(type_num) {
-    case NPY_INT8:
-        dtype = 0;
-        break;
-    case NPY_INT16:
-        dtype = 1;
-        break;
-    case NPY_INT32:
-        dtype = 2;
-        break;
-    case NPY_INT64:
-        dtype = 3;
-        break;
-    case NPY_UINT8:
-        dtype = 4;
-        break;
-    case NPY_UINT16:
-        dtype = 5;
-        break;
-    case NPY_UINT32:
-        dtype = 6;
-        break;
-    case NPY_UINT64:
-        dtype = 7;
-        break;
-    case NPY_FLOAT32:
-        dtype = 8;
-        break;
-    case NPY_FLOAT64:
-        dtype = 9;
-        break;
-    case NPY_COMPLEX64:
-        dtype = 10;
-        break;
-    case NPY_COMPLEX128:
-        dtype = 11;
-        break;
-    default:
-        /* Type not included in the global lookup table */
-        dtype = -1;
-    }
-    return dtype;
+    if ((unsigned int) type_num >= NPY_NTYPES)
+        return -1;
+    return dtype_num_lut[type_num];
 }
 
 static
@@ -678,27 +1266,17 @@ void cache_ndarray_typecode(int ndim, int layout, PyArray_Descr* descr,
     Py_DECREF(value);
 }
 
-static
+static NB_ATTR_HOT
 int typecode_ndarray(PyObject *dispatcher, PyArrayObject *ary) {
     int typecode;
     int dtype;
     int ndim = PyArray_NDIM(ary);
-    int layout = 0;
-
-    /* The order in which we check for the right contiguous-ness is important.
-       The order must match the order by numba.numpy_support.map_layout.
-       Further, only *contiguous-ness* is checked, not alignment, byte order or
-       write permissions.
-    */
-    if (PyArray_IS_C_CONTIGUOUS(ary)){
-        layout = 1;
-    } else if (PyArray_IS_F_CONTIGUOUS(ary)) {
-        layout = 2;
-    }
+    int flags = PyArray_FLAGS(ary);
+    int layout = flags_to_layout(flags);
 
     /* the typecode cache by convention is for "behaved" arrays (aligned and
      * writeable), all others must be forced to the fall back */
-    if (!PyArray_ISBEHAVED(ary)) goto FALLBACK;
+    if ((flags & NPY_ARRAY_BEHAVED) != NPY_ARRAY_BEHAVED) goto FALLBACK;
 
     if (ndim <= 0 || ndim > N_NDIM) goto FALLBACK;
 
@@ -710,11 +1288,11 @@ int typecode_ndarray(PyObject *dispatcher, PyArrayObject *ary) {
     assert(ndim <= N_NDIM);
     assert(dtype < N_DTYPES);
 
-    typecode = cached_arycode[ndim - 1][layout][dtype];
+    typecode = cached_arycode[ARYCODE_IDX(ndim - 1, layout, dtype)];
     if (typecode == -1) {
         /* First use of this table entry, so it requires populating */
         typecode = typecode_fallback_keep_ref(dispatcher, (PyObject*)ary);
-        cached_arycode[ndim - 1][layout][dtype] = typecode;
+        cached_arycode[ARYCODE_IDX(ndim - 1, layout, dtype)] = typecode;
     }
     return typecode;
 
@@ -739,6 +1317,16 @@ static
 int typecode_arrayscalar(PyObject *dispatcher, PyObject* aryscalar) {
     int typecode;
     PyArray_Descr *descr;
+
+    /* Fast path for the basic scalar types, resolved without
+       materializing a descr */
+    typecode = fast_scalar_typenum(aryscalar);
+    if (typecode >= 0) {
+        typecode = dtype_num_to_typecode(typecode);
+        if (typecode >= 0)
+            return BASIC_TYPECODES[typecode];
+    }
+
     descr = PyArray_DescrFromScalar(aryscalar);
     if (!descr)
         return typecode_using_fingerprint(dispatcher, aryscalar);
@@ -763,7 +1351,7 @@ int typecode_arrayscalar(PyObject *dispatcher, PyObject* aryscalar) {
     return BASIC_TYPECODES[typecode];
 }
 
-int
+NB_ATTR_HOT int
 typeof_typecode(PyObject *dispatcher, PyObject *val)
 {
     PyTypeObject *tyobj = Py_TYPE(val);
@@ -788,11 +1376,34 @@ typeof_typecode(PyObject *dispatcher, PyObject *val)
         return tc_float64;
     else if (tyobj == &PyComplex_Type)
         return tc_complex128;
+    /* Array fast path: the exact ndarray type covers nearly all arrays.
+       Replicate typecode_ndarray()'s direct table lookup here so the
+       common case resolves with a handful of loads and no function
+       call; any miss falls through to the full logic. */
+    else if (NPY_LIKELY(tyobj == &PyArray_Type)) {
+        PyArrayObject *ary = (PyArrayObject *) val;
+        int ndim = PyArray_NDIM(ary);
+        int flags = PyArray_FLAGS(ary);
+        int dtype, typecode;
+        if ((unsigned int) (ndim - 1) < N_NDIM &&
+            (flags & NPY_ARRAY_BEHAVED) == NPY_ARRAY_BEHAVED) {
+            dtype = dtype_num_to_typecode(PyArray_TYPE(ary));
+            if (dtype >= 0) {
+                int layout = flags_to_layout(flags);
+                typecode = cached_arycode[ARYCODE_IDX(ndim - 1, layout, dtype)];
+                if (typecode != -1)
+                    return typecode;
+            }
+        }
+        return typecode_ndarray(dispatcher, ary);
+    }
     /* Array scalar handling */
     else if (PyArray_CheckScalar(val)) {
         return typecode_arrayscalar(dispatcher, val);
     }
-    /* Array handling */
+    /* Handling for ndarray subclasses, which miss the exact type check
+       above; PyType_IsSubtype walks the MRO so keep it off the fast
+       path. */
     else if (PyType_IsSubtype(tyobj, &PyArray_Type)) {
         return typecode_ndarray(dispatcher, (PyArrayObject*)val);
     }
@@ -891,10 +1502,14 @@ typeof_init(PyObject *self, PyObject *args)
         return NULL;
     }
 
-    fingerprint_hashtable = _Numba_hashtable_new(sizeof(int),
-                                              hash_writer,
-                                              compare_writer);
-    if (fingerprint_hashtable == NULL) {
+    /* Preallocate the fingerprint cache and the first arena chunk (a
+       zero-sized allocation only maps in a chunk), so no dispatch ever
+       sees a missing table. */
+    if (fp_cache.entries == NULL && fp_cache_resize(FP_CACHE_INITIAL_SIZE)) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    if (fp_arena == NULL && fp_arena_alloc(0) == NULL) {
         PyErr_NoMemory();
         return NULL;
     }
@@ -902,6 +1517,61 @@ typeof_init(PyObject *self, PyObject *args)
     /* initialize cached_arycode to all ones (in bits) */
     memset(cached_arycode, 0xFF, sizeof(cached_arycode));
 
+    /* Initialize the dtype number LUT (see dtype_num_to_typecode).
+       The indices must match the BASIC_TYPECODES order above. */
+    memset(dtype_num_lut, -1, sizeof(dtype_num_lut));
+    dtype_num_lut[NPY_INT8] = 0;
+    dtype_num_lut[NPY_INT16] = 1;
+    dtype_num_lut[NPY_INT32] = 2;
+    dtype_num_lut[NPY_INT64] = 3;
+    dtype_num_lut[NPY_UINT8] = 4;
+    dtype_num_lut[NPY_UINT16] = 5;
+    dtype_num_lut[NPY_UINT32] = 6;
+    dtype_num_lut[NPY_UINT64] = 7;
+    dtype_num_lut[NPY_FLOAT32] = 8;
+    dtype_num_lut[NPY_FLOAT64] = 9;
+    dtype_num_lut[NPY_COMPLEX64] = 10;
+    dtype_num_lut[NPY_COMPLEX128] = 11;
+
+    /* Populate the tuple-element emitter table (see fingerprint_tuple),
+       hottest element types first. */
+    fp_dispatch_n = 0;
+    #define REGISTER_EMITTER(TP, FN) \
+        do { assert(fp_dispatch_n < FP_DISPATCH_MAX); \
+             fp_dispatch[fp_dispatch_n].type = (TP); \
+             fp_dispatch[fp_dispatch_n].emit = (FN); \
+             fp_dispatch_n++; } while (0)
+
+    REGISTER_EMITTER(&PyArray_Type, fp_emit_ndarray);
+    REGISTER_EMITTER(&PyLong_Type, fp_emit_int);
+    REGISTER_EMITTER(&PyFloat_Type, fp_emit_float);
+    REGISTER_EMITTER(Py_TYPE(Py_None), fp_emit_none);
+    REGISTER_EMITTER(&PyBool_Type, fp_emit_bool);
+    REGISTER_EMITTER(&PyComplex_Type, fp_emit_complex);
+    REGISTER_EMITTER(&PyTuple_Type, fingerprint_tuple);
+
+    #undef REGISTER_EMITTER
+
+    /* Populate the scalar type -> typenum fast dispatch table.  The
+       typenums must match the BASIC_TYPECODES order above. */
+    {
+        static const char basic_typenums[N_FAST_SCALARS] = {
+            NPY_INT8, NPY_INT16, NPY_INT32, NPY_INT64,
+            NPY_UINT8, NPY_UINT16, NPY_UINT32, NPY_UINT64,
+            NPY_FLOAT32, NPY_FLOAT64,
+            NPY_COMPLEX64, NPY_COMPLEX128
+        };
+        int i;
+        for (i = 0; i < N_FAST_SCALARS; i++) {
+            PyArray_Descr *descr = PyArray_DescrFromType(basic_typenums[i]);
+            if (descr == NULL)
+                return NULL;
+            fast_scalars[i].scalar_type = descr->typeobj;
+            fast_scalars[i].typenum = basic_typenums[i];
+            Py_DECREF(descr);
+        }
+    }
+
     str_typeof_pyval = PyString_InternFromString("typeof_pyval");
     str_value = PyString_InternFromString("value");
     str_numba_type = PyString_InternFromString("_numba_type_");
@@ -49,6 +49,15 @@ install_name_tool_fixer = []
 if sys.platform == 'darwin':
     install_name_tool_fixer += ['-headerpad_max_install_names']
 
+# Profile-guided optimization of the dispatcher hot paths (gcc/clang
+# only): build once with NUMBA_PGO=generate, run a training workload
+# (e.g. the test suite), then rebuild with NUMBA_PGO=use.
+PGO_CFLAGS = []
+if os.environ.get("NUMBA_PGO") == "generate":
+    PGO_CFLAGS = ["-fprofile-generate"]
+elif os.environ.get("NUMBA_PGO") == "use":
+    PGO_CFLAGS = ["-fprofile-use", "-fprofile-correction"]
+
 
 def is_building():
     """
@@ -112,6 +121,8 @@ def get_ext_modules():
                                         'numba/_hashtable.c',
                                         'numba/_dispatcherimpl.cpp',
                                         'numba/typeconv/typeconv.cpp'],
+                               extra_compile_args=PGO_CFLAGS,
+                               extra_link_args=PGO_CFLAGS,
                                depends=["numba/_pymodule.h",
                                         "numba/_dispatcher.h",
                                         "numba/_typeof.h",